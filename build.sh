@@ -5,7 +5,7 @@
 set -e
 
 : "${CC=}"
-: "${CFLAGS=-Wall -Wextra}"
+: "${CFLAGS=-Wall -Wextra -pthread}"
 
 if [ -z "$CC" ]; then
     if command -v gcc >/dev/null 2>&1; then
@@ -5,5 +5,8 @@ int main(void) {
   printf("SUPPORTS_VEC_INIT: %s\n", SUPPORTS_VEC_INIT ? "true" : "false");
   printf("SUPPORTS_VEC_FOREACH: %s\n", SUPPORTS_VEC_FOREACH ? "true" : "false");
   printf("SUPPORTS_VEC_FIND: %s\n", SUPPORTS_VEC_FIND ? "true" : "false");
+  printf("SUPPORTS_VEC_SHARE: %s\n", SUPPORTS_VEC_SHARE ? "true" : "false");
+  printf("SUPPORTS_SHARDED_LRU: %s\n",
+         SUPPORTS_SHARDED_LRU ? "true" : "false");
   return 0;
 }
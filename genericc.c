@@ -6,6 +6,9 @@
 #include <assert.h>
 #include <stdio.h>
 #include <string.h>
+#if HAS_THREADS
+#include <threads.h>
+#endif // HAS_THREADS
 
 DEFINE_VEC(Ints, int);
 DEFINE_VEC(StaticStrings, const char *);
@@ -14,6 +17,28 @@ typedef struct {
   int y;
 } Point;
 DEFINE_VEC(Points, Point);
+DEFINE_VEC(PointRefs, Point *);
+DEFINE_FIXED_VEC(FixedInts, int, 4);
+DEFINE_FIXED_VEC(FixedPoints, Point, 2);
+DEFINE_FIXED_VEC(FixedStaticStrings, const char *, 8);
+
+size_t hash_int(int x) { return (size_t)x; }
+size_t hash_collide(int x) { return (void)x, 42; }
+int eq_int(int a, int b) { return a == b; }
+size_t hash_str(const char *s) {
+  size_t h = 5381;
+  while (*s)
+    h = h * 33 + (unsigned char)*s++;
+  return h;
+}
+int eq_str(const char *a, const char *b) { return strcmp(a, b) == 0; }
+
+DEFINE_LRU(IntCache, int, int, hash_int, eq_int, 3);
+DEFINE_LRU(CollidingCache, int, int, hash_collide, eq_int, 4);
+DEFINE_LRU(PointCache, const char *, Point, hash_str, eq_str, 2);
+#if SUPPORTS_SHARDED_LRU
+DEFINE_SHARDED_LRU(ShardedCache, int, int, hash_int, eq_int, 64, 4);
+#endif // SUPPORTS_SHARDED_LRU
 
 int is_even(int x) { return x % 2 != 0; }
 int is_origin(Point p) { return !(p.x == 0 && p.y == 0) ? 1 : 0; }
@@ -219,6 +244,106 @@ void test_vec_foreach_static_strings(void) {
 
   vec_free(&v);
 }
+
+void test_vec_foreach_batch_ints(void) {
+  Ints v;
+  vec_init_with(int, &v, 2, 3, 5, 7, 11, 13, 17);
+
+  size_t batches = 0;
+  int sum = 0;
+  vec_foreach_batch(it, &v, 3) {
+    assert(it == v.items + batches * 3);
+    batches++;
+    for (size_t i = 0; i < 3; ++i)
+      sum += it[i];
+  }
+  assert(batches == 2);
+  assert(sum == 41);
+
+  size_t tail = 0;
+  vec_foreach_batch_tail(it, &v, 3) {
+    assert(it == v.items + 6);
+    sum += *it;
+    tail++;
+  }
+  assert(tail == 1);
+  assert(sum == 58);
+
+  vec_free(&v);
+}
+
+void test_vec_foreach_batch_points(void) {
+  Points v;
+  vec_init_with(Point, &v, (Point){2, 3}, (Point){5, 7}, (Point){11, 13});
+
+  // A chunk larger than the vector leaves everything to the tail.
+  vec_foreach_batch(it, &v, 8) { assert(0 && "Unreachable"); }
+  size_t ref_idx = 0;
+  vec_foreach_batch_tail(p, &v, 8) {
+    assert(p - v.items == (ssize_t)ref_idx);
+    ref_idx++;
+  }
+  assert(ref_idx == 3);
+
+  Points empty = {0};
+  vec_foreach_batch(it, &empty, 4) { assert(0 && "Unreachable"); }
+  vec_foreach_batch_tail(it, &empty, 4) { assert(0 && "Unreachable"); }
+
+  vec_free(&v);
+}
+
+void test_vec_foreach_batch_static_strings(void) {
+  StaticStrings v;
+  vec_init_with(const char *, &v, "foo", "bar", "hello", "baz");
+
+  // Read-only snapshots must be scannable through a const pointer.
+  const StaticStrings *cv = &v;
+  ssize_t found = -1;
+  vec_foreach_batch(it, cv, 2) {
+    int res[2];
+    for (size_t i = 0; i < 2; ++i)
+      res[i] = match_hello(it[i]);
+    for (size_t i = 0; i < 2; ++i) {
+      if (found < 0 && res[i] == 0)
+        found = it - cv->items + i;
+    }
+  }
+  vec_foreach_batch_tail(it, cv, 2) { assert(0 && "Unreachable"); }
+  assert(found == 2);
+
+  vec_free(&v);
+}
+
+void test_vec_foreach_prefetch_static_strings(void) {
+  StaticStrings v;
+  vec_init_with(const char *, &v, "foo", "bar", "hello", "baz");
+
+  size_t ref_idx = 0;
+  ssize_t found = -1;
+  vec_foreach_prefetch(s, &v, 2) {
+    size_t idx = s - v.items;
+    assert(idx == ref_idx++);
+    if (found < 0 && match_hello(*s) == 0)
+      found = idx;
+  }
+  assert(ref_idx == 4);
+  assert(found == 2);
+
+  vec_free(&v);
+}
+
+void test_vec_foreach_prefetch_point_refs(void) {
+  Point pts[] = {{2, 3}, {5, 7}, {11, 13}};
+  PointRefs v;
+  vec_init_with(Point *, &v, &pts[0], &pts[1], &pts[2]);
+
+  // A distance past the end must not prefetch out of bounds.
+  int sum = 0;
+  vec_foreach_prefetch(p, &v, 16) { sum += (*p)->x; }
+  assert(sum == 18);
+
+  vec_free(&v);
+}
 #endif // SUPPORTS_VEC_FOREACH
 
 // === Tests for vec_init ===
@@ -303,6 +428,327 @@ void test_vec_find_strings(void) {
 }
 #endif // SUPPORTS_VEC_FIND
 
+// === Tests for vec_share/clone ===
+#if SUPPORTS_VEC_SHARE
+void test_vec_share_ints(void) {
+  Ints v;
+  vec_init_with(int, &v, 1, 2, 3);
+
+  Ints snapshot;
+  vec_share(&snapshot, &v);
+  assert(snapshot.items == v.items);
+  assert(vec_len(&snapshot) == 3);
+
+  vec_push(&v, 4);
+  assert(snapshot.items != v.items);
+  assert(vec_len(&v) == 4);
+  assert(vec_len(&snapshot) == 3);
+  assert(vec_at(&snapshot, 2) == 3);
+  assert(snapshot.refs != NULL && v.refs == NULL);
+
+  vec_free(&v);
+  assert(vec_at(&snapshot, 0) == 1);
+  vec_free(&snapshot);
+}
+
+void test_vec_share_points(void) {
+  Points v;
+  vec_init_with(Point, &v, (Point){1, 2}, (Point){3, 4});
+
+  Points copy;
+  vec_clone(&copy, &v);
+  assert(copy.items == v.items);
+
+  vec_unshare(&copy);
+  assert(copy.items != v.items);
+  vec_foreach_with(Point, p, &copy) { p->x = 0; }
+  assert(vec_at(&copy, 1).x == 0);
+  assert(vec_at(&v, 1).x == 3);
+
+  // `v` is the last owner now, so it mutates in place without copying.
+  Point *items = v.items;
+  vec_push(&v, ((Point){5, 6}));
+  assert(v.items == items);
+  assert(v.refs == NULL);
+
+  vec_free(&copy);
+  vec_free(&v);
+}
+
+void test_vec_share_static_strings(void) {
+  StaticStrings v = {0};
+  vec_push(&v, "foo");
+  vec_push(&v, "bar");
+
+  StaticStrings a, b;
+  vec_share(&a, &v);
+  vec_share(&b, &a);
+  assert(a.items == v.items && b.items == v.items);
+
+  vec_free(&v);
+  vec_free(&a);
+  assert(strncmp(vec_at(&b, 1), "bar", strlen("bar")) == 0);
+
+  vec_pop(&b);
+  assert(vec_len(&b) == 1);
+  vec_free(&b);
+}
+
+#if HAS_THREADS
+#define SHARE_ROUNDS 200
+#define SHARE_LEN 64
+
+typedef struct {
+  Ints snapshot;
+  atomic_bool owner_done;
+} ShareArgs;
+
+// Reads the snapshot while the owner copies and frees its side, then drops
+// what must be the last reference.
+int vec_share_reader(void *arg) {
+  ShareArgs *args = arg;
+  while (!atomic_load(&args->owner_done)) {
+    assert(vec_len(&args->snapshot) == SHARE_LEN);
+    for (size_t i = 0; i < SHARE_LEN; ++i)
+      assert(vec_at(&args->snapshot, i) == (int)i);
+  }
+  assert(atomic_load(args->snapshot.refs) == 1);
+  vec_free(&args->snapshot);
+  return 0;
+}
+
+void test_vec_share_threads(void) {
+  for (int round = 0; round < SHARE_ROUNDS; ++round) {
+    Ints v = {0};
+    for (int i = 0; i < SHARE_LEN; ++i)
+      vec_push(&v, i);
+
+    ShareArgs args;
+    vec_share(&args.snapshot, &v);
+    atomic_init(&args.owner_done, false);
+
+    thrd_t reader;
+    int res = thrd_create(&reader, vec_share_reader, &args);
+    assert(res == thrd_success);
+    (void)res;
+
+    // Copies the buffer away from the reader, so its view never changes.
+    vec_push(&v, -1);
+    assert(v.items != args.snapshot.items && v.refs == NULL);
+    assert(vec_len(&v) == SHARE_LEN + 1 && vec_at(&v, 0) == 0);
+    vec_free(&v);
+    atomic_store(&args.owner_done, true);
+
+    thrd_join(reader, NULL);
+  }
+}
+#endif // HAS_THREADS
+#endif // SUPPORTS_VEC_SHARE
+
+// === Tests for DEFINE_FIXED_VEC ===
+void test_fixed_vec_ints(void) {
+  FixedInts v = {0};
+  _Static_assert(fvec_cap(&v) == 4, "Capacity must be a constant");
+
+  assert(fvec_push(&v, 1));
+  assert(fvec_push(&v, 2));
+  assert(fvec_push(&v, 3));
+  assert(fvec_push(&v, 4));
+  assert(!fvec_push(&v, 5));
+  assert(vec_len(&v) == 4);
+  assert(fvec_at(&v, 3) == 4);
+
+  fvec_at(&v, 0) = 7;
+  assert(vec_at(&v, 0) == 7);
+
+  assert(vec_pop(&v) == 4);
+  assert(fvec_push(&v, 6));
+  assert(vec_at(&v, 3) == 6);
+
+  vec_clear(&v);
+  assert(vec_len(&v) == 0);
+}
+
+void test_fixed_vec_points(void) {
+  FixedPoints v;
+  fvec_init_with(Point, &v, (Point){1, 2}, (Point){0, 0});
+
+  assert(vec_len(&v) == 2);
+  assert(fvec_at(&v, 0).y == 2);
+  assert(!fvec_push(&v, ((Point){3, 4})));
+
+  size_t ref_idx = 0;
+  vec_foreach_with(Point, p, &v) {
+    assert(p - v.items == (ssize_t)ref_idx++);
+  }
+  assert(ref_idx == 2);
+}
+
+void test_fixed_vec_static_strings(void) {
+  FixedStaticStrings v;
+  fvec_init_with(const char *, &v, "foo", "bar");
+  assert(fvec_push(&v, "hello"));
+  assert(fvec_push(&v, "baz"));
+
+  assert(vec_len(&v) == 4);
+  assert(strncmp(fvec_at(&v, 2), "hello", strlen("hello")) == 0);
+}
+
+#if SUPPORTS_VEC_INIT && SUPPORTS_VEC_FOREACH && SUPPORTS_VEC_FIND
+void test_fixed_vec_shared_macros(void) {
+  FixedInts v;
+  fvec_init(&v, 1, 3, 5, 8);
+
+  int sum = 0;
+  vec_foreach(x, &v) { sum += *x; }
+  assert(sum == 17);
+  assert(vec_find(&v, is_even) == 3);
+
+  FixedStaticStrings strs;
+  fvec_init(&strs, "foo", "bar", "hello", "baz");
+  assert(vec_find(&strs, match_hello) == 2);
+}
+#endif // SUPPORTS_VEC_INIT && SUPPORTS_VEC_FOREACH && SUPPORTS_VEC_FIND
+
+// === Tests for DEFINE_LRU ===
+void test_lru_ints(void) {
+  IntCache c = {0};
+  int out = 0;
+  assert(!IntCache_get(&c, 1, &out));
+
+  assert(!IntCache_put(&c, 1, 10));
+  assert(!IntCache_put(&c, 2, 20));
+  assert(!IntCache_put(&c, 3, 30));
+  assert(lru_len(&c) == 3);
+
+  // Touching 1 makes 2 the least recently used entry.
+  assert(IntCache_get(&c, 1, &out) && out == 10);
+  assert(IntCache_put(&c, 4, 40));
+  assert(lru_len(&c) == 3);
+  assert(!IntCache_get(&c, 2, NULL));
+  assert(IntCache_get(&c, 3, &out) && out == 30);
+  assert(IntCache_get(&c, 4, &out) && out == 40);
+
+  // Updating an existing key does not evict.
+  assert(!IntCache_put(&c, 1, 11));
+  assert(IntCache_get(&c, 1, &out) && out == 11);
+
+  assert(c.hits == 4);
+  assert(c.misses == 2);
+}
+
+void test_lru_evict_colliding(void) {
+  CollidingCache c = {0};
+  for (int i = 0; i < 4; ++i)
+    CollidingCache_put(&c, i, i * i);
+
+  int key, value;
+  assert(CollidingCache_evict(&c, &key, &value));
+  assert(key == 0 && value == 0);
+  assert(CollidingCache_evict(&c, &key, &value));
+  assert(key == 1 && value == 1);
+  assert(lru_len(&c) == 2);
+
+  // Every key shares one probe chain, so these only succeed if removals
+  // shifted the survivors back correctly.
+  assert(!CollidingCache_get(&c, 0, NULL));
+  assert(CollidingCache_get(&c, 3, &value) && value == 9);
+  assert(CollidingCache_get(&c, 2, &value) && value == 4);
+
+  for (int i = 10; i < 20; ++i)
+    CollidingCache_put(&c, i, i);
+  assert(lru_len(&c) == 4);
+  for (int i = 16; i < 20; ++i)
+    assert(CollidingCache_get(&c, i, &value) && value == i);
+  assert(!CollidingCache_get(&c, 15, NULL));
+
+  while (CollidingCache_evict(&c, NULL, NULL))
+    ;
+  assert(lru_len(&c) == 0);
+}
+
+void test_lru_static_strings(void) {
+  PointCache c = {0};
+  char key[] = "origin";
+  PointCache_put(&c, "origin", (Point){0, 0});
+  PointCache_put(&c, "unit", (Point){1, 1});
+
+  // Keys are compared with `eq`, not by address.
+  Point p;
+  assert(PointCache_get(&c, key, &p) && p.x == 0 && p.y == 0);
+  assert(PointCache_put(&c, "hello", (Point){5, 5}));
+  assert(!PointCache_get(&c, "unit", NULL));
+  assert(PointCache_get(&c, "hello", &p) && p.x == 5);
+}
+
+#if SUPPORTS_SHARDED_LRU
+void test_lru_sharded(void) {
+  ShardedCache c;
+  ShardedCache_init(&c);
+
+  for (int i = 0; i < 32; ++i)
+    assert(!ShardedCache_put(&c, i, -i));
+  for (int i = 0; i < 32; ++i) {
+    int out;
+    assert(ShardedCache_get(&c, i, &out) && out == -i);
+  }
+  assert(!ShardedCache_get(&c, 100, NULL));
+
+  size_t hits, misses;
+  ShardedCache_stats(&c, &hits, &misses);
+  assert(hits == 32 && misses == 1);
+
+  ShardedCache_destroy(&c);
+}
+
+#define LRU_THREADS 4
+#define LRU_ROUNDS 1000
+#define LRU_KEYS 16
+
+// Every thread writes the same keys, and a key always maps to its own value,
+// so each get must hit and see that value no matter how threads interleave.
+// Even if all keys land in one shard they fit (64 / 4 = 16 entries each).
+int lru_sharded_worker(void *arg) {
+  ShardedCache *c = arg;
+  for (int round = 0; round < LRU_ROUNDS; ++round) {
+    for (int k = 0; k < LRU_KEYS; ++k) {
+      int out = -1;
+      ShardedCache_put(c, k, k * 2);
+      assert(ShardedCache_get(c, k, &out) && out == k * 2);
+    }
+  }
+  return 0;
+}
+
+void test_lru_sharded_threads(void) {
+  ShardedCache c;
+  ShardedCache_init(&c);
+
+  thrd_t threads[LRU_THREADS];
+  for (size_t i = 0; i < LRU_THREADS; ++i) {
+    int res = thrd_create(&threads[i], lru_sharded_worker, &c);
+    assert(res == thrd_success);
+    (void)res;
+  }
+  for (size_t i = 0; i < LRU_THREADS; ++i)
+    thrd_join(threads[i], NULL);
+
+  size_t hits, misses;
+  ShardedCache_stats(&c, &hits, &misses);
+  assert(hits == LRU_THREADS * LRU_ROUNDS * LRU_KEYS);
+  assert(misses == 0);
+
+  size_t total = 0;
+  for (size_t i = 0; i < sizeof(c.shards) / sizeof(c.shards[0]); ++i) {
+    assert(lru_len(&c.shards[i].cache) <= 16);
+    total += lru_len(&c.shards[i].cache);
+  }
+  assert(total == LRU_KEYS);
+
+  ShardedCache_destroy(&c);
+}
+#endif // SUPPORTS_SHARDED_LRU
+
 // We can use #ifdef ... #endif, but let's go with simpler approach:
 // commenting out irrelevant tests. Then Visual Studio users can also easily
 // follow the process.
@@ -331,6 +777,16 @@ int main(void) {
   printf("PASS: test_vec_foreach_points\n");
   test_vec_foreach_static_strings();
   printf("PASS: test_vec_foreach_static_strings\n");
+  test_vec_foreach_batch_ints();
+  printf("PASS: test_vec_foreach_batch_ints\n");
+  test_vec_foreach_batch_points();
+  printf("PASS: test_vec_foreach_batch_points\n");
+  test_vec_foreach_batch_static_strings();
+  printf("PASS: test_vec_foreach_batch_static_strings\n");
+  test_vec_foreach_prefetch_static_strings();
+  printf("PASS: test_vec_foreach_prefetch_static_strings\n");
+  test_vec_foreach_prefetch_point_refs();
+  printf("PASS: test_vec_foreach_prefetch_point_refs\n");
 #endif // SUPPORTS_VEC_FOREACH
 #if SUPPORTS_VEC_INIT
   test_vec_init_ints();
@@ -348,6 +804,42 @@ int main(void) {
   test_vec_find_strings();
   printf("PASS: test_vec_find_strings\n");
 #endif // SUPPORTS_VEC_FIND
+#if SUPPORTS_VEC_SHARE
+  test_vec_share_ints();
+  printf("PASS: test_vec_share_ints\n");
+  test_vec_share_points();
+  printf("PASS: test_vec_share_points\n");
+  test_vec_share_static_strings();
+  printf("PASS: test_vec_share_static_strings\n");
+#if HAS_THREADS
+  test_vec_share_threads();
+  printf("PASS: test_vec_share_threads\n");
+#endif // HAS_THREADS
+#endif // SUPPORTS_VEC_SHARE
+
+  test_fixed_vec_ints();
+  printf("PASS: test_fixed_vec_ints\n");
+  test_fixed_vec_points();
+  printf("PASS: test_fixed_vec_points\n");
+  test_fixed_vec_static_strings();
+  printf("PASS: test_fixed_vec_static_strings\n");
+#if SUPPORTS_VEC_INIT && SUPPORTS_VEC_FOREACH && SUPPORTS_VEC_FIND
+  test_fixed_vec_shared_macros();
+  printf("PASS: test_fixed_vec_shared_macros\n");
+#endif // SUPPORTS_VEC_INIT && SUPPORTS_VEC_FOREACH && SUPPORTS_VEC_FIND
+
+  test_lru_ints();
+  printf("PASS: test_lru_ints\n");
+  test_lru_evict_colliding();
+  printf("PASS: test_lru_evict_colliding\n");
+  test_lru_static_strings();
+  printf("PASS: test_lru_static_strings\n");
+#if SUPPORTS_SHARDED_LRU
+  test_lru_sharded();
+  printf("PASS: test_lru_sharded\n");
+  test_lru_sharded_threads();
+  printf("PASS: test_lru_sharded_threads\n");
+#endif // SUPPORTS_SHARDED_LRU
 
   printf("ALL PASSED!\n");
   return 0;
@@ -3,17 +3,44 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(__GNUC__) || defined(__clang__)
 #define HAS_TYPEOF 1
 #define HAS_STMT_EXPRS 1
+#define HAS_BUILTIN_PREFETCH 1
 #elif defined(_MSC_FULL_VER) && _MSC_FULL_VER >= 193933428
 #define HAS_TYPEOF 1
 #define HAS_STMT_EXPRS 0
+#define HAS_BUILTIN_PREFETCH 0
 #else
 #define HAS_TYPEOF 0
 #define HAS_STMT_EXPRS 0
+#define HAS_BUILTIN_PREFETCH 0
+#endif
+
+// C11 made <stdatomic.h> optional; implementations without it must define
+// `__STDC_NO_ATOMICS__` (e.g. MSVC without `/experimental:c11atomics`).
+#if defined(__STDC_NO_ATOMICS__)
+#define HAS_ATOMICS 0
+#else
+#define HAS_ATOMICS 1
+#endif
+
+// Same for <threads.h>, but some C libraries (e.g. macOS) ship neither the
+// header nor the macro, so ask the preprocessor as well when we can.
+#if defined(__STDC_NO_THREADS__)
+#define HAS_THREADS 0
+#elif defined(__has_include)
+#if __has_include(<threads.h>)
+#define HAS_THREADS 1
+#else
+#define HAS_THREADS 0
+#endif
+#else
+#define HAS_THREADS 1
 #endif
 
 #ifndef SUPPORTS_VEC_INIT
@@ -26,14 +53,62 @@
 #define SUPPORTS_VEC_FIND (HAS_TYPEOF && HAS_STMT_EXPRS)
 #endif
 
+#ifndef SUPPORTS_VEC_SHARE
+#define SUPPORTS_VEC_SHARE HAS_ATOMICS
+#endif
+#ifndef SUPPORTS_SHARDED_LRU
+#define SUPPORTS_SHARDED_LRU HAS_THREADS
+#endif
+
+#if SUPPORTS_SHARDED_LRU
+#include <threads.h>
+#endif
+
+#if SUPPORTS_VEC_SHARE
+#include <stdatomic.h>
+typedef atomic_size_t vec_refcount_t;
+#define REFCNT_LOAD(refs) atomic_load_explicit((refs), memory_order_acquire)
+#define REFCNT_INC(refs)                                                       \
+  atomic_fetch_add_explicit((refs), 1, memory_order_relaxed)
+#define REFCNT_DEC(refs)                                                       \
+  atomic_fetch_sub_explicit((refs), 1, memory_order_acq_rel)
+#else // SUPPORTS_VEC_SHARE
+// `refs` stays NULL when sharing is unavailable, so these are never reached at
+// runtime; they only have to compile.
+typedef size_t vec_refcount_t;
+#define REFCNT_LOAD(refs) (*(refs))
+#define REFCNT_INC(refs) ((*(refs))++)
+#define REFCNT_DEC(refs) ((*(refs))--)
+#endif // SUPPORTS_VEC_SHARE
+
+// A prefetch is only a hint, so compilers without one simply skip it.
+#if HAS_BUILTIN_PREFETCH
+#define PREFETCH(addr) __builtin_prefetch((addr))
+#else
+#define PREFETCH(addr) ((void)(addr))
+#endif
+
 #define INITIAL_CAP 8
 #define CAP_INC_FACTOR 2
 
 #define TYPE_EQ(expr, type) /* TODO */
 
-// SAFETY: This is neither reentrant nor thread-safe!
+// SAFETY: This is neither reentrant nor thread-safe! The only exception is the
+// reference count of a shared buffer (see `vec_share`); a single handle must
+// still not be touched by more than one thread at a time.
+// Note:
+//   - `refs` is NULL while the vector solely owns `items`, so a
+//     zero-initialized vector (`{0}`) is a valid, empty, unshared vector.
 #define DEFINE_VEC(name, type) /* TODO */
 
+// Makes `vec` the sole owner of its buffer, copying it if other handles still
+// refer to it. Every mutating macro calls this first (through `vec_reserve`),
+// so users only need it before writing through `vec_foreach`/`items`.
+// Note:
+//   - If ours turns out to be the last reference while copying, the original
+//     buffer is released here instead of leaking.
+#define vec_unshare(vec) /* TODO */
+
 #define vec_reserve(vec, expected_cap) /* TODO */
 
 #define vec_push(vec, item) /* TODO */
@@ -46,6 +121,9 @@
 
 #define vec_clear(vec) /* TODO */
 
+// Note:
+//   - On a shared vector this only drops our reference; the buffer is freed
+//     by whichever handle releases it last.
 #define vec_free(vec) /* TODO */
 
 // Caveat:
@@ -100,6 +178,50 @@
 //   - `it` here is a pointer to the current element.
 #define vec_foreach_with(elem_type, it, vec) /* TODO */
 
+// Vector with inline storage for at most `n` elements, e.g. a small lookup
+// table living on the stack. It has the same `items` and `length` members as
+// `DEFINE_VEC`, so every read-only macro (`vec_at`, `vec_len`, `vec_pop`,
+// `vec_clear`, `vec_foreach`, `vec_find`, ...) works on it unchanged. The
+// capacity is part of the type, so the `fvec_*` macros below check it at
+// compile time where they can, and never allocate.
+// Note:
+//   - `vec_push`, `vec_reserve`, `vec_free`, `vec_share` and
+//     `vec_foreach_batch` need a heap buffer and do not compile on it.
+//   - Zero-initialization (`{0}`) gives a valid, empty vector.
+#define DEFINE_FIXED_VEC(name, type, n) /* TODO */
+
+// `_Static_assert` is a declaration, not an expression. Declaring it inside a
+// struct that is only used as the operand of `sizeof` lets us place it where an
+// expression is expected; nothing is evaluated at runtime. Multiplying by zero
+// keeps the result an integer constant expression that can be added to an index
+// or a size, which a comma expression would not be.
+#define STATIC_ASSERT_ZERO(cond, msg) /* TODO */
+
+// Whether `items` is an array rather than a pointer, i.e. whether `vec` comes
+// from `DEFINE_FIXED_VEC`. For a pointer `&(vec)->items` has type `T **`, while
+// for an array it has type `T (*)[n]`. Without `typeof` we cannot tell, so the
+// check is skipped.
+#define IS_FIXED_VEC(vec) /* TODO */
+
+// An integer constant expression, since `sizeof` does not evaluate `vec`.
+// Passing a heap vector is a compile error rather than `sizeof(T *) / sizeof(T)`.
+#define fvec_cap(vec) /* TODO */
+
+// Same as `vec_at`, but `i` must be an integer constant expression, so that
+// indexing past the capacity is a compile error. `i` is still checked against
+// `length` at runtime. Unlike `vec_at`, this is an lvalue, so it can also
+// overwrite an existing element. Use `vec_at` for indices only known at runtime.
+#define fvec_at(vec, i) /* TODO */
+
+// Appends `item` unless the vector is full. Evaluates to `true` if `item` was
+// appended and `false` on overflow, in which case nothing is written.
+#define fvec_push(vec, item) /* TODO */
+
+// Same as `vec_init_with`, but passing more than `fvec_cap(vec)` elements is a
+// compile error.
+// Caveat: same as `vec_init_with`
+#define fvec_init_with(elem_type, vec, ...) /* TODO */
+
 #if HAS_TYPEOF
 
 // Uses GNU-style `typeof`, standardized in C23:
@@ -115,8 +237,41 @@
 // Caveat: same as `vec_init_with`
 #define vec_init(vec, ...) /* TODO */
 
+#define fvec_init(vec, ...) /* TODO */
+
 #define vec_foreach(it, vec) /* TODO */
 
+// Walks `vec` in chunks of exactly `n` elements, so that the body can issue
+// `n` independent loads, e.g. `for (size_t i = 0; i < N; ++i) f(it[i]);` with a
+// constant trip count the compiler can unroll. The remaining
+// `vec_len(vec) % n` elements are left to `vec_foreach_batch_tail`:
+//
+//   vec_foreach_batch(it, &v, 4) { /* it[0] .. it[3] */ }
+//   vec_foreach_batch_tail(it, &v, 4) { /* *it, one element at a time */ }
+//
+// Note:
+//   - `it` here is a pointer to the first element of the current chunk.
+//   - `n` should be an integer constant expression; otherwise the body has no
+//     constant bound to exploit. It is evaluated on every iteration, so keep it
+//     free of side effects.
+#define vec_foreach_batch(it, vec, n) /* TODO */
+
+// Visits, one by one, the elements that `vec_foreach_batch` with the same `n`
+// left out because they do not fill a whole chunk.
+// Note:
+//   - `it` here is a pointer to the current element, as in `vec_foreach`.
+#define vec_foreach_batch_tail(it, vec, n) /* TODO */
+
+// Same as `vec_foreach`, but also prefetches the object pointed to by the
+// element `dist` positions ahead, so that cache misses of pointer-chasing
+// loops (e.g. comparing strings of `StaticStrings`) overlap each other instead
+// of being serialized.
+// Note:
+//   - The element type must be a pointer.
+//   - A good `dist` roughly covers memory latency divided by the time spent
+//     per element; it is worth measuring rather than guessing.
+#define vec_foreach_prefetch(it, vec, dist) /* TODO */
+
 #else // HAS_TYPEOF
 
 #pragma message(                                                               \
@@ -149,4 +304,127 @@
 
 #endif // HAS_STMT_EXPRS && HAS_TYPEOF
 
+#if SUPPORTS_VEC_SHARE
+
+// Makes `dst` another owner of `src`'s buffer in O(1); no element is copied.
+// Uses C11 atomics for the reference count:
+//   - References:
+//     - https://en.cppreference.com/w/c/atomic
+// Compatibility:
+//   - GCC / Clang: supported
+//   - MSVC: requires `/experimental:c11atomics`
+// Note:
+//   - Both handles must be released with `vec_free`.
+//   - The buffer is immutable while shared: the first mutating call on either
+//     handle copies it (copy-on-write), so a snapshot handed to another thread
+//     never observes later writes, and nothing races on the elements.
+//   - `dst` is overwritten, so it must not own a buffer of its own.
+#define vec_share(dst, src) /* TODO */
+
+// A clone is a share whose copy is deferred until the first mutation; see
+// `vec_share` and `vec_unshare`.
+#define vec_clone(dst, src) /* TODO */
+
+#else // SUPPORTS_VEC_SHARE
+
+#pragma message(                                                               \
+    "Warning: vec_share and vec_clone are disabled on this compiler.")
+
+#endif // SUPPORTS_VEC_SHARE
+
+// Fixed-capacity least-recently-used cache mapping `key_type` to `value_type`.
+// Unlike the vector macros, lookups need `hash` and `eq` baked in, so this
+// defines the struct together with `static inline` functions prefixed by
+// `name`:
+//
+//   bool name_get(name *lru, key_type key, value_type *out);
+//   bool name_put(name *lru, key_type key, value_type value);
+//   bool name_evict(name *lru, key_type *key, value_type *value);
+//
+// `name_get` returns whether `key` was found and marks it most recently used.
+// `name_put` inserts or updates `key` and returns whether the least recently
+// used entry had to be evicted to make room. `name_evict` removes the least
+// recently used entry, if any. `out`, `key` and `value` may be NULL.
+//
+// All three are O(1) on average and never allocate:
+//   - `index` is an open-addressing (linear probing) table of slot numbers,
+//     kept at most half full. Removal shifts the following entries back
+//     instead of leaving tombstones, so probes stay short under churn.
+//   - Recency is a doubly linked list threaded through `prev` and `next`, which
+//     are indices into the slot arrays rather than pointers to malloc'ed nodes.
+//
+// Note:
+//   - `hash` must be `size_t hash(key_type)` and `eq` must be
+//     `int eq(key_type, key_type)` returning non-zero when the keys are equal.
+//   - Indices in `index`, `prev`, `next`, `head`, `tail` and `free_slots` are
+//     stored as slot + 1, so that a zero-initialized cache (`{0}`) is a valid,
+//     empty one.
+//   - `hits` and `misses` count the outcomes of `name_get`.
+// SAFETY: Same as `DEFINE_VEC`; see `DEFINE_SHARDED_LRU` for concurrent use.
+#define DEFINE_LRU(name, key_type, value_type, hash, eq, capacity) /* TODO */
+
+// Keeping the index at most half full bounds the expected probe length.
+#define LRU_INDEX_CAP(capacity) (2 * (capacity))
+
+#define lru_len(lru) /* TODO */
+
+#if SUPPORTS_SHARDED_LRU
+
+// Same as `DEFINE_LRU`, but splits the cache into `nshards` independent
+// `name_shard` caches of `capacity / nshards` (rounded up) entries each, every
+// one guarded by its own mutex. A key always maps to the same shard, so
+// threads only contend when they touch the same shard:
+//
+//   void name_init(name *lru);
+//   void name_destroy(name *lru);
+//   bool name_get(name *lru, key_type key, value_type *out);
+//   bool name_put(name *lru, key_type key, value_type value);
+//   void name_stats(name *lru, size_t *hits, size_t *misses);
+//
+// Uses C11 threads:
+//   - References:
+//     - https://en.cppreference.com/w/c/thread
+// Compatibility:
+//   - GCC / Clang: depends on the C library (glibc 2.28 or later, musl). Before
+//     glibc 2.34 these functions live in libpthread, so link with `-pthread`
+//     (as `build.sh` does).
+//   - MSVC: supported since Visual Studio 17.8
+// Note:
+//   - Even `name_get` takes the shard lock, since a hit updates the recency
+//     list. Sharding is what keeps readers from serializing on one lock.
+//   - Unlike `DEFINE_LRU`, call `name_init` first and `name_destroy` last.
+//   - Every shard (with its lock) is aligned to `CACHE_LINE_SIZE`, so a `name`
+//     allocated with plain `malloc` may be under-aligned; prefer static or
+//     automatic storage, or `aligned_alloc`.
+//   - Recency is tracked per shard, so the evicted entry is the least recently
+//     used one of its shard, not necessarily of the whole cache.
+#define DEFINE_SHARDED_LRU(name, key_type, value_type, hash, eq, capacity,     \
+                           nshards) /* TODO */
+
+// Shards pick from the top 16 bits of a Fibonacci-hashed key, while each shard
+// indexes with `h % LRU_INDEX_CAP`. This keeps the two choices independent even
+// for identity hashes of small integers. The multiplier is 2^w / phi for the
+// width w of `size_t`.
+#if SIZE_MAX > 0xFFFFFFFFu
+#define FIB_HASH_MUL ((size_t)0x9E3779B97F4A7C15ull)
+#else
+#define FIB_HASH_MUL ((size_t)0x9E3779B9u)
+#endif
+
+// Typical for x86-64 and most ARM cores; only used to keep shards apart.
+#define CACHE_LINE_SIZE 64
+
+#define LRU_SHARD_BITS 16
+#define LRU_MAX_SHARDS ((size_t)1 << LRU_SHARD_BITS)
+
+#define LRU_SHARD_OF(h, nshards)                                               \
+  ((size_t)(((h) * FIB_HASH_MUL) >> (sizeof(size_t) * 8 - LRU_SHARD_BITS)) %   \
+   (nshards))
+
+#else // SUPPORTS_SHARDED_LRU
+
+#pragma message("Warning: DEFINE_SHARDED_LRU is disabled on this compiler.")
+
+#endif // SUPPORTS_SHARDED_LRU
+
 #endif // GENERICC_H